@@ -0,0 +1,377 @@
+#include "uaclientpool.h"
+
+#include <QDebug>
+#include <QOpcUaReadItem>
+#include <QSettings>
+
+#include <algorithm>
+
+namespace {
+
+// Server_ServerStatus_CurrentTime, read to keep idle sessions alive
+const QString KeepAliveNodeId = QStringLiteral("ns=0;i=2258");
+
+QString modeName(QOpcUaEndpointDescription::MessageSecurityMode mode)
+{
+    switch (mode) {
+    case QOpcUaEndpointDescription::MessageSecurityMode::None:
+        return QStringLiteral("None");
+    case QOpcUaEndpointDescription::MessageSecurityMode::Sign:
+        return QStringLiteral("Sign");
+    case QOpcUaEndpointDescription::MessageSecurityMode::SignAndEncrypt:
+        return QStringLiteral("SignAndEncrypt");
+    default:
+        return QStringLiteral("Invalid");
+    }
+}
+
+} // namespace
+
+UaClientPool::UaClientPool(QObject *parent)
+    : QObject(parent)
+    , m_provider(new QOpcUaProvider(this))
+    , m_exploreUntried(qEnvironmentVariableIntValue("UA_POLICY_EXPLORE") != 0)
+    , m_hasPki(false)
+    , m_idleTimeoutMs(60000)
+{
+    if (!m_provider->availableBackends().isEmpty())
+        m_backend = m_provider->availableBackends().first();
+
+    const QString preference = qEnvironmentVariable("UA_POLICY_PREFERENCE");
+    for (const QString &policy : preference.split(',', Qt::SkipEmptyParts))
+        m_preference.append(policy.trimmed());
+
+    loadStats();
+
+    m_keepAliveTimer.setInterval(10000);
+    connect(&m_keepAliveTimer, &QTimer::timeout, this, &UaClientPool::keepAlive);
+    m_keepAliveTimer.start();
+}
+
+UaClientPool::~UaClientPool()
+{
+    // Best effort, the clients are deleted with the pool
+    for (const IdleClient &idle : std::as_const(m_idle))
+        idle.client->disconnectFromEndpoint();
+    for (auto it = m_busy.cbegin(); it != m_busy.cend(); ++it)
+        it.key()->disconnectFromEndpoint();
+}
+
+void UaClientPool::setPkiConfiguration(const QOpcUaPkiConfiguration &pki, const QOpcUaApplicationIdentity &identity)
+{
+    m_pki = pki;
+    m_identity = identity;
+    m_hasPki = true;
+}
+
+void UaClientPool::acquire(const QUrl &url)
+{
+    // Reuse a warm session if there is one
+    for (int i = 0; i < m_idle.size(); ++i) {
+        if (m_idle.at(i).url != url || m_idle.at(i).client->state() != QOpcUaClient::ClientState::Connected)
+            continue;
+        QOpcUaClient *client = m_idle.takeAt(i).client;
+        m_busy.insert(client, url);
+        // Keep the signal asynchronous, like a fresh connect
+        QMetaObject::invokeMethod(this, [this, url, client]() {
+            if (m_busy.contains(client))
+                emit clientReady(url, client);
+        }, Qt::QueuedConnection);
+        return;
+    }
+
+    if (!isValid()) {
+        QMetaObject::invokeMethod(this, [this, url]() {
+            emit acquireFailed(url, "No OPC UA backends available");
+        }, Qt::QueuedConnection);
+        return;
+    }
+
+    QOpcUaClient *client = createClient(url);
+    if (!client) {
+        QMetaObject::invokeMethod(this, [this, url]() {
+            emit acquireFailed(url, "Failed to create OPC UA client");
+        }, Qt::QueuedConnection);
+        return;
+    }
+
+    const auto cached = m_endpoints.constFind(url.toString());
+    if (cached != m_endpoints.cend()) {
+        onEndpoints(client, *cached);
+    } else {
+        qDebug() << "Requesting endpoints from" << url.toString();
+        client->requestEndpoints(url);
+    }
+}
+
+void UaClientPool::release(QOpcUaClient *client)
+{
+    const auto it = m_busy.constFind(client);
+    if (it == m_busy.cend())
+        return;
+
+    const QUrl url = it.value();
+    m_busy.erase(it);
+
+    if (client->state() == QOpcUaClient::ClientState::Connected) {
+        IdleClient idle { url, client, QElapsedTimer() };
+        idle.since.start();
+        m_idle.append(idle);
+    } else {
+        client->deleteLater();
+    }
+}
+
+QStringList UaClientPool::statsSummary() const
+{
+    QStringList lines;
+    for (auto it = m_stats.cbegin(); it != m_stats.cend(); ++it) {
+        lines.append(QString("%1: %2 connects, %3 failures, %4 ms mean connect")
+                         .arg(it.key())
+                         .arg(it->connects)
+                         .arg(it->failures)
+                         .arg(it->meanConnectMs(), 0, 'f', 1));
+    }
+    lines.sort();
+    return lines;
+}
+
+QOpcUaClient *UaClientPool::createClient(const QUrl &url)
+{
+    QOpcUaClient *client = m_provider->createClient(m_backend);
+    if (!client)
+        return nullptr;
+    client->setParent(this);
+    if (m_hasPki) {
+        client->setPkiConfiguration(m_pki);
+        client->setApplicationIdentity(m_identity);
+    }
+
+    PendingConnect pending;
+    pending.url = url;
+    m_pending.insert(client, pending);
+
+    connect(client, &QOpcUaClient::stateChanged, this, [this, client](QOpcUaClient::ClientState state) {
+        onStateChanged(client, state);
+    });
+    connect(client, &QOpcUaClient::endpointsRequestFinished, this,
+            [this, client](QList<QOpcUaEndpointDescription> endpoints, QOpcUa::UaStatusCode statusCode) {
+                if (!m_pending.contains(client))
+                    return;
+                if (statusCode != QOpcUa::UaStatusCode::Good || endpoints.isEmpty()) {
+                    fail(client, "No endpoints available");
+                    return;
+                }
+                m_endpoints.insert(m_pending.value(client).url.toString(), endpoints);
+                onEndpoints(client, endpoints);
+            });
+    // connectToEndpoint() can refuse an endpoint without any state change,
+    // e.g. AccessDenied for a secure one without PKI
+    connect(client, &QOpcUaClient::errorChanged, this, [this, client](QOpcUaClient::ClientError error) {
+        const auto pending = m_pending.constFind(client);
+        if (error != QOpcUaClient::NoError && pending != m_pending.cend() && pending->attempting)
+            attemptFailed(client);
+    });
+    return client;
+}
+
+void UaClientPool::onEndpoints(QOpcUaClient *client, const QList<QOpcUaEndpointDescription> &endpoints)
+{
+    PendingConnect &pending = m_pending[client];
+    pending.candidates = rank(pending.url, endpoints);
+    pending.next = 0;
+    if (pending.candidates.isEmpty()) {
+        fail(client, "Only secure endpoints offered and no PKI configured");
+        return;
+    }
+    connectNext(client);
+}
+
+void UaClientPool::connectNext(QOpcUaClient *client)
+{
+    PendingConnect &pending = m_pending[client];
+    if (pending.next >= pending.candidates.size()) {
+        fail(client, "Could not connect to any endpoint");
+        return;
+    }
+
+    const QOpcUaEndpointDescription &endpoint = pending.candidates.at(pending.next++);
+    pending.policy = policyKey(endpoint);
+    qDebug() << "Connecting with" << pending.policy << "to" << endpoint.endpointUrl();
+    pending.timer.start();
+    pending.attempting = true;
+    client->connectToEndpoint(endpoint);
+}
+
+void UaClientPool::attemptFailed(QOpcUaClient *client)
+{
+    PendingConnect &pending = m_pending[client];
+    pending.attempting = false;
+    ++m_stats[statsKey(pending.url, pending.policy)].failures;
+    saveStats(pending.url, pending.policy);
+    // The cached endpoint list may be outdated, rediscover next time
+    m_endpoints.remove(pending.url.toString());
+
+    // Try the next best endpoint once the signals of this failure (error and
+    // state change) have all been delivered, so they are counted only once
+    QMetaObject::invokeMethod(this, [this, client]() {
+        if (m_pending.contains(client))
+            connectNext(client);
+    }, Qt::QueuedConnection);
+}
+
+void UaClientPool::onStateChanged(QOpcUaClient *client, QOpcUaClient::ClientState state)
+{
+    const auto pending = m_pending.find(client);
+    if (pending != m_pending.end()) {
+        if (state == QOpcUaClient::ClientState::Connected) {
+            PolicyStats &stats = m_stats[statsKey(pending->url, pending->policy)];
+            ++stats.connects;
+            stats.totalConnectMs += pending->timer.nsecsElapsed() / 1e6;
+            saveStats(pending->url, pending->policy);
+
+            const QUrl url = pending->url;
+            m_pending.erase(pending);
+            m_busy.insert(client, url);
+            emit clientReady(url, client);
+        } else if (state == QOpcUaClient::ClientState::Disconnected && pending->attempting) {
+            attemptFailed(client);
+        }
+        return;
+    }
+
+    if (state != QOpcUaClient::ClientState::Disconnected)
+        return;
+
+    // A warm session went away, or a caller's session dropped
+    for (int i = 0; i < m_idle.size(); ++i) {
+        if (m_idle.at(i).client == client) {
+            m_idle.removeAt(i);
+            client->deleteLater();
+            return;
+        }
+    }
+    if (m_busy.remove(client))
+        client->deleteLater();
+}
+
+void UaClientPool::fail(QOpcUaClient *client, const QString &error)
+{
+    const QUrl url = m_pending.take(client).url;
+    m_endpoints.remove(url.toString());
+    client->deleteLater();
+    emit acquireFailed(url, error);
+}
+
+void UaClientPool::keepAlive()
+{
+    for (int i = m_idle.size() - 1; i >= 0; --i) {
+        const IdleClient &idle = m_idle.at(i);
+        if (idle.since.hasExpired(m_idleTimeoutMs)) {
+            QOpcUaClient *client = m_idle.takeAt(i).client;
+            client->disconnectFromEndpoint();
+            client->deleteLater();
+        } else {
+            idle.client->readNodeAttributes({ QOpcUaReadItem(KeepAliveNodeId) });
+        }
+    }
+}
+
+QList<QOpcUaEndpointDescription> UaClientPool::rank(const QUrl &url, const QList<QOpcUaEndpointDescription> &endpoints) const
+{
+    // Secure endpoints cannot connect without certificates
+    QList<QOpcUaEndpointDescription> usable;
+    for (const QOpcUaEndpointDescription &endpoint : endpoints) {
+        if (m_hasPki || endpoint.securityMode() == QOpcUaEndpointDescription::MessageSecurityMode::None)
+            usable.append(endpoint);
+    }
+
+    QList<QOpcUaEndpointDescription> ranked;
+    for (const QOpcUaEndpointDescription &endpoint : std::as_const(usable)) {
+        if (preferenceIndex(endpoint.securityPolicy()) < m_preference.size())
+            ranked.append(endpoint);
+    }
+    if (ranked.isEmpty())
+        ranked = usable;
+
+    // Within one preference: policies that connected before, cheapest first,
+    // then untried ones as fallback, then ones that only ever failed. With
+    // exploration untried policies go first, so each gets measured once.
+    // Ties go to the endpoint with the lower security level.
+    const double untried = m_exploreUntried ? -1.0 : std::numeric_limits<double>::max() / 2;
+    auto cost = [this, &url, untried](const QOpcUaEndpointDescription &endpoint) {
+        const auto stats = m_stats.constFind(statsKey(url, policyKey(endpoint)));
+        if (stats == m_stats.cend() || (stats->connects == 0 && stats->failures == 0))
+            return untried;
+        return stats->expectedConnectMs();
+    };
+
+    std::stable_sort(ranked.begin(), ranked.end(),
+                     [this, &cost](const QOpcUaEndpointDescription &a, const QOpcUaEndpointDescription &b) {
+                         const int prefA = preferenceIndex(a.securityPolicy());
+                         const int prefB = preferenceIndex(b.securityPolicy());
+                         if (prefA != prefB)
+                             return prefA < prefB;
+                         const double costA = cost(a);
+                         const double costB = cost(b);
+                         if (costA != costB)
+                             return costA < costB;
+                         return a.securityLevel() < b.securityLevel();
+                     });
+    return ranked;
+}
+
+int UaClientPool::preferenceIndex(const QString &policyUri) const
+{
+    const QString shortName = policyUri.section('#', -1);
+    for (int i = 0; i < m_preference.size(); ++i) {
+        const QString &preferred = m_preference.at(i);
+        if (preferred.compare(policyUri, Qt::CaseInsensitive) == 0
+            || preferred.compare(shortName, Qt::CaseInsensitive) == 0)
+            return i;
+    }
+    return int(m_preference.size());
+}
+
+void UaClientPool::loadStats()
+{
+    QSettings settings("QtUASamples", "UaClientPool");
+    settings.beginGroup("connectCost");
+    // QSettings treats '/' as a group separator, hence the encoding
+    for (const QString &server : settings.childGroups()) {
+        const QUrl url(QUrl::fromPercentEncoding(server.toLatin1()));
+        settings.beginGroup(server);
+        for (const QString &group : settings.childGroups()) {
+            settings.beginGroup(group);
+            PolicyStats stats;
+            stats.connects = settings.value("connects").toInt();
+            stats.failures = settings.value("failures").toInt();
+            stats.totalConnectMs = settings.value("totalConnectMs").toDouble();
+            settings.endGroup();
+            m_stats.insert(statsKey(url, QString(group).replace('+', '/')), stats);
+        }
+        settings.endGroup();
+    }
+}
+
+void UaClientPool::saveStats(const QUrl &url, const QString &policy) const
+{
+    const PolicyStats stats = m_stats.value(statsKey(url, policy));
+    QSettings settings("QtUASamples", "UaClientPool");
+    settings.beginGroup("connectCost");
+    settings.beginGroup(QString::fromLatin1(QUrl::toPercentEncoding(url.toString())));
+    settings.beginGroup(QString(policy).replace('/', '+'));
+    settings.setValue("connects", stats.connects);
+    settings.setValue("failures", stats.failures);
+    settings.setValue("totalConnectMs", stats.totalConnectMs);
+}
+
+QString UaClientPool::policyKey(const QOpcUaEndpointDescription &endpoint)
+{
+    return endpoint.securityPolicy().section('#', -1) + '/' + modeName(endpoint.securityMode());
+}
+
+QString UaClientPool::statsKey(const QUrl &url, const QString &policy)
+{
+    return url.toString() + ' ' + policy;
+}
@@ -0,0 +1,142 @@
+#ifndef UACLIENTPOOL_H
+#define UACLIENTPOOL_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QOpcUaApplicationIdentity>
+#include <QOpcUaClient>
+#include <QOpcUaEndpointDescription>
+#include <QOpcUaPkiConfiguration>
+#include <QOpcUaProvider>
+#include <QStringList>
+#include <QTimer>
+#include <QUrl>
+
+#include <limits>
+
+// Hands out connected QOpcUaClient objects and keeps released ones connected
+// for reuse, so a repeated operation on the same server skips endpoint
+// discovery, the secure channel handshake and session activation.
+//
+// Endpoints are ranked by the configured security policy preference first and
+// by the measured connect cost of each policy/mode on that server second.
+// Policies not tried on a server yet only come after the ones known to work,
+// unless exploration is enabled. Secure endpoints are skipped until a PKI
+// configuration is set. Connect times are kept in QSettings so the ranking
+// improves across runs.
+class UaClientPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct PolicyStats
+    {
+        int connects = 0;
+        int failures = 0;
+        double totalConnectMs = 0; // secure channel + create/activate session
+        double meanConnectMs() const { return connects ? totalConnectMs / connects : 0; }
+        // Mean connect time scaled by the attempts needed per success
+        double expectedConnectMs() const
+        {
+            if (!connects)
+                return failures ? std::numeric_limits<double>::max() : 0;
+            return meanConnectMs() * (connects + failures) / connects;
+        }
+    };
+
+    explicit UaClientPool(QObject *parent = nullptr);
+    ~UaClientPool() override;
+
+    bool isValid() const { return !m_backend.isEmpty(); }
+
+    // Security policies in order of preference, either full URIs or the part
+    // after '#' ("None", "Basic256Sha256", ...). Endpoints using other
+    // policies are only tried when no preferred one is offered. An empty list
+    // ranks purely by cost. Defaults to the comma separated
+    // UA_POLICY_PREFERENCE environment variable.
+    void setPolicyPreference(const QStringList &policies) { m_preference = policies; }
+    QStringList policyPreference() const { return m_preference; }
+
+    // Try policies without measurements before the measured ones, so each
+    // gets measured once. Defaults to the UA_POLICY_EXPLORE environment
+    // variable being set to a non-zero number.
+    void setExploreUntried(bool explore) { m_exploreUntried = explore; }
+    bool exploreUntried() const { return m_exploreUntried; }
+
+    // Certificates for Sign and SignAndEncrypt endpoints. Without them only
+    // endpoints with security mode None are used.
+    void setPkiConfiguration(const QOpcUaPkiConfiguration &pki, const QOpcUaApplicationIdentity &identity);
+
+    void setKeepAliveInterval(int msec) { m_keepAliveTimer.setInterval(msec); }
+    void setIdleTimeout(int msec) { m_idleTimeoutMs = msec; }
+
+    // Emits clientReady() or acquireFailed() once a session is available.
+    // The pool keeps ownership of the client.
+    void acquire(const QUrl &url);
+
+    // Give a client back. Connected clients stay warm until the idle timeout.
+    // Callers should drop their own signal connections to the client first.
+    void release(QOpcUaClient *client);
+
+    QHash<QString, PolicyStats> policyStats() const { return m_stats; }
+    QStringList statsSummary() const;
+
+signals:
+    void clientReady(const QUrl &url, QOpcUaClient *client);
+    void acquireFailed(const QUrl &url, const QString &error);
+
+private:
+    struct PendingConnect
+    {
+        QUrl url;
+        QList<QOpcUaEndpointDescription> candidates;
+        int next = 0;
+        QString policy;
+        QElapsedTimer timer;
+        bool attempting = false; // an outcome for the current endpoint is due
+    };
+
+    struct IdleClient
+    {
+        QUrl url;
+        QOpcUaClient *client;
+        QElapsedTimer since;
+    };
+
+    QOpcUaClient *createClient(const QUrl &url);
+    void onStateChanged(QOpcUaClient *client, QOpcUaClient::ClientState state);
+    void onEndpoints(QOpcUaClient *client, const QList<QOpcUaEndpointDescription> &endpoints);
+    void connectNext(QOpcUaClient *client);
+    void attemptFailed(QOpcUaClient *client);
+    void fail(QOpcUaClient *client, const QString &error);
+    void keepAlive();
+
+    QList<QOpcUaEndpointDescription> rank(const QUrl &url, const QList<QOpcUaEndpointDescription> &endpoints) const;
+    int preferenceIndex(const QString &policyUri) const;
+
+    void loadStats();
+    void saveStats(const QUrl &url, const QString &policy) const;
+
+    static QString policyKey(const QOpcUaEndpointDescription &endpoint);
+    static QString statsKey(const QUrl &url, const QString &policy);
+
+    QOpcUaProvider *m_provider;
+    QString m_backend;
+    QStringList m_preference;
+    bool m_exploreUntried;
+    bool m_hasPki;
+    QOpcUaPkiConfiguration m_pki;
+    QOpcUaApplicationIdentity m_identity;
+    int m_idleTimeoutMs;
+    QTimer m_keepAliveTimer;
+
+    QHash<QString, QList<QOpcUaEndpointDescription>> m_endpoints; // by server URL
+    QHash<QOpcUaClient *, PendingConnect> m_pending;
+    QHash<QOpcUaClient *, QUrl> m_busy;
+    QList<IdleClient> m_idle;
+    QHash<QString, PolicyStats> m_stats; // by "<server URL> <Policy/Mode>"
+};
+
+#endif // UACLIENTPOOL_H
@@ -0,0 +1,180 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+# define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "uatrace.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <time.h>
+#endif
+
+/* Events per thread, about 32 bytes each, kept as a ring: once full the
+ * oldest events are overwritten. Must be a power of two so the ring index
+ * stays continuous when the 32 bit event count wraps. */
+#ifndef UATRACE_BUFFER_EVENTS
+# define UATRACE_BUFFER_EVENTS (256 * 1024)
+#endif
+#if (UATRACE_BUFFER_EVENTS & (UATRACE_BUFFER_EVENTS - 1)) != 0
+# error UATRACE_BUFFER_EVENTS must be a power of two
+#endif
+
+#if defined(_MSC_VER)
+# define UATRACE_THREAD_LOCAL __declspec(thread)
+#else
+# define UATRACE_THREAD_LOCAL __thread
+#endif
+
+typedef struct {
+    const char *name;
+    int64_t value;
+    uint64_t ts_ns;
+    char phase;
+} uatrace_record;
+
+/* Written by its own thread only. count is the number of events ever
+ * recorded, published with release semantics after the record is complete;
+ * the exporter reads the last UATRACE_BUFFER_EVENTS of them. A thread still
+ * tracing while the buffers are written out may overwrite records as they
+ * are read, so dump after the traced work has stopped. */
+typedef struct uatrace_buffer {
+    struct uatrace_buffer *next;
+    uint32_t tid;
+#ifdef _MSC_VER
+    volatile LONG count;
+#else
+    uint32_t count;
+#endif
+    uatrace_record records[UATRACE_BUFFER_EVENTS];
+} uatrace_buffer;
+
+static uatrace_buffer *buffers; /* lock-free list, push only */
+static uint32_t next_tid;
+static UATRACE_THREAD_LOCAL uatrace_buffer *thread_buffer;
+
+static uint64_t
+now_ns(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if(frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static uint32_t
+load_count(uatrace_buffer *b) {
+#ifdef _MSC_VER
+    return (uint32_t)InterlockedCompareExchange(&b->count, 0, 0);
+#else
+    return __atomic_load_n(&b->count, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static void
+store_count(uatrace_buffer *b, uint32_t count) {
+#ifdef _MSC_VER
+    InterlockedExchange(&b->count, (LONG)count);
+#else
+    __atomic_store_n(&b->count, count, __ATOMIC_RELEASE);
+#endif
+}
+
+static uatrace_buffer *
+register_thread(void) {
+    uatrace_buffer *b = (uatrace_buffer *)calloc(1, sizeof(uatrace_buffer));
+    if(!b)
+        return NULL;
+
+#ifdef _MSC_VER
+    b->tid = (uint32_t)InterlockedIncrement((volatile LONG *)&next_tid);
+    do {
+        b->next = buffers;
+    } while(InterlockedCompareExchangePointer((PVOID volatile *)&buffers, b, b->next) != b->next);
+#else
+    b->tid = __atomic_add_fetch(&next_tid, 1, __ATOMIC_RELAXED);
+    b->next = __atomic_load_n(&buffers, __ATOMIC_RELAXED);
+    while(!__atomic_compare_exchange_n(&buffers, &b->next, b, 1,
+                                       __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        ;
+#endif
+    return b;
+}
+
+void
+uatrace_event(const char *name, char phase, int64_t value) {
+    uatrace_buffer *b = thread_buffer;
+    if(!b) {
+        b = thread_buffer = register_thread();
+        if(!b)
+            return;
+    }
+
+    /* Only this thread writes count, a plain read is enough here */
+    uint32_t count = (uint32_t)b->count;
+    uatrace_record *r = &b->records[count & (UATRACE_BUFFER_EVENTS - 1)];
+    r->name = name;
+    r->value = value;
+    r->ts_ns = now_ns();
+    r->phase = phase;
+    store_count(b, count + 1);
+}
+
+int
+uatrace_write_json(const char *path) {
+    if(!path)
+        path = getenv("UATRACE_FILE");
+    if(!path || !*path)
+        path = "uatrace.json";
+
+    FILE *f = fopen(path, "w");
+    if(!f)
+        return -1;
+
+#ifdef _MSC_VER
+    uatrace_buffer *head = (uatrace_buffer *)InterlockedCompareExchangePointer((PVOID volatile *)&buffers, NULL, NULL);
+#else
+    uatrace_buffer *head = __atomic_load_n(&buffers, __ATOMIC_ACQUIRE);
+#endif
+
+    unsigned long long overwritten = 0;
+    int first = 1;
+    fputs("{\"traceEvents\":[\n", f);
+    for(uatrace_buffer *b = head; b; b = b->next) {
+        uint32_t count = load_count(b);
+        uint32_t kept = count < UATRACE_BUFFER_EVENTS ? count : UATRACE_BUFFER_EVENTS;
+        overwritten += count - kept;
+        for(uint32_t i = count - kept; i != count; i++) {
+            const uatrace_record *r = &b->records[i & (UATRACE_BUFFER_EVENTS - 1)];
+            fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u",
+                    first ? "" : ",\n", r->name, r->phase, (double)r->ts_ns / 1000.0,
+                    (unsigned)b->tid);
+            if(r->phase == 'C')
+                fprintf(f, ",\"args\":{\"value\":%lld}", (long long)r->value);
+            else if(r->phase == 'i')
+                fputs(",\"s\":\"t\"", f);
+            fputc('}', f);
+            first = 0;
+        }
+    }
+    fprintf(f, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"overwritten\":%llu}}\n", overwritten);
+
+    /* Only the end of the run is in the file, spans cut at the start show
+     * up unmatched */
+    if(overwritten > 0)
+        fprintf(stderr, "uatrace: %llu oldest events were overwritten, %s only holds the last %u per thread\n",
+                overwritten, path, (unsigned)UATRACE_BUFFER_EVENTS);
+
+    return fclose(f) == 0 ? 0 : -1;
+}
@@ -0,0 +1,19 @@
+# Hot-path trace points shared by the sample clients, see uatrace.h.
+# include() this file and call uatrace_configure(<target>).
+
+option(UATRACE "Compile in hot-path trace points (Chrome trace-event JSON)" OFF)
+
+set(UATRACE_DIR ${CMAKE_CURRENT_LIST_DIR})
+
+if(UATRACE)
+    # The recorder is plain C so pocsub can use it as well
+    enable_language(C)
+endif()
+
+function(uatrace_configure target)
+    target_include_directories(${target} PRIVATE ${UATRACE_DIR})
+    if(UATRACE)
+        target_sources(${target} PRIVATE ${UATRACE_DIR}/uatrace.c)
+        target_compile_definitions(${target} PRIVATE UATRACE_ENABLED)
+    endif()
+endfunction()
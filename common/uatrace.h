@@ -0,0 +1,76 @@
+#ifndef UATRACE_H
+#define UATRACE_H
+
+/* Hot-path trace points for the sample clients.
+ *
+ * Configure with -DUATRACE=ON to compile them in. Every thread records into
+ * its own fixed size ring buffer without locks, keeping the most recent
+ * events; UATRACE_DUMP() writes all buffers as Chrome trace-event JSON
+ * (chrome://tracing, Perfetto) to the file named by the UATRACE_FILE
+ * environment variable, or uatrace.json. Without UATRACE the macros expand
+ * to nothing.
+ *
+ * Event names must be string literals, only the pointer is stored. */
+
+#ifdef UATRACE_ENABLED
+#include <stdint.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef UATRACE_ENABLED
+
+void uatrace_event(const char *name, char phase, int64_t value);
+int uatrace_write_json(const char *path);
+
+# define UATRACE_BEGIN(name) uatrace_event(name, 'B', 0)
+# define UATRACE_END(name) uatrace_event(name, 'E', 0)
+# define UATRACE_INSTANT(name) uatrace_event(name, 'i', 0)
+# define UATRACE_COUNTER(name, value) uatrace_event(name, 'C', (int64_t)(value))
+/* void either way, so call sites build with tracing on and off */
+# define UATRACE_DUMP() ((void)uatrace_write_json(0))
+
+#else
+
+# define UATRACE_BEGIN(name) ((void)0)
+# define UATRACE_END(name) ((void)0)
+# define UATRACE_INSTANT(name) ((void)0)
+# define UATRACE_COUNTER(name, value) ((void)0)
+# define UATRACE_DUMP() ((void)0)
+
+#endif
+
+#ifdef __cplusplus
+}
+
+#ifdef UATRACE_ENABLED
+
+// Begin/end pair for the enclosing C++ scope
+class UaTraceScope
+{
+public:
+    explicit UaTraceScope(const char *name) : m_name(name) { uatrace_event(m_name, 'B', 0); }
+    ~UaTraceScope() { uatrace_event(m_name, 'E', 0); }
+
+    UaTraceScope(const UaTraceScope &) = delete;
+    UaTraceScope &operator=(const UaTraceScope &) = delete;
+
+private:
+    const char *m_name;
+};
+
+# define UATRACE_CONCAT_(a, b) a##b
+# define UATRACE_CONCAT(a, b) UATRACE_CONCAT_(a, b)
+# define UATRACE_SCOPE(name) UaTraceScope UATRACE_CONCAT(uatraceScope, __LINE__)(name)
+
+#else
+
+# define UATRACE_SCOPE(name) ((void)0)
+
+#endif
+
+#endif /* __cplusplus */
+
+#endif /* UATRACE_H */
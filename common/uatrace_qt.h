@@ -0,0 +1,49 @@
+#ifndef UATRACE_QT_H
+#define UATRACE_QT_H
+
+#include "uatrace.h"
+
+#include <QEvent>
+#include <QObject>
+
+#ifdef UATRACE_ENABLED
+
+// Application wrapper that traces event dispatch on the GUI thread: queued
+// signal deliveries (the OPC UA backend thread hands every update over this
+// way), update requests and widget paints.
+template <class Base>
+class UaTraceApplication : public Base
+{
+public:
+    using Base::Base;
+
+    bool notify(QObject *receiver, QEvent *event) override
+    {
+        switch (event->type()) {
+        case QEvent::MetaCall: {
+            UATRACE_SCOPE("qt.queued_call");
+            return Base::notify(receiver, event);
+        }
+        case QEvent::UpdateRequest: {
+            UATRACE_SCOPE("qt.update_request");
+            return Base::notify(receiver, event);
+        }
+        case QEvent::Paint: {
+            UATRACE_SCOPE("qt.paint");
+            return Base::notify(receiver, event);
+        }
+        default:
+            return Base::notify(receiver, event);
+        }
+    }
+};
+
+#else
+
+// No notify() override at all when tracing is off
+template <class Base>
+using UaTraceApplication = Base;
+
+#endif
+
+#endif // UATRACE_QT_H
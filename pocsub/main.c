@@ -3,6 +3,7 @@
 #include <open62541/plugin/log_stdout.h>
 
 // #include "common.h"
+#include "uatrace.h"
 
 #include <signal.h>
 #include <stdlib.h>
@@ -26,6 +27,7 @@ static void stopHandler(int sign) {
 static void
 handler_currentTimeChanged(UA_Client *client, UA_UInt32 subId, void *subContext,
                            UA_UInt32 monId, void *monContext, UA_DataValue *value) {
+    UATRACE_BEGIN("callback");
     if(UA_Variant_hasScalarType(&value->value, &UA_TYPES[UA_TYPES_DOUBLE])) {
         UA_Double val = *(UA_Double *) value->value.data;
         UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND,
@@ -38,6 +40,7 @@ handler_currentTimeChanged(UA_Client *client, UA_UInt32 subId, void *subContext,
         UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND,
                     "Value type: %s", value->value.type->typeName);
     }
+    UATRACE_END("callback");
 }
 
 static void
@@ -183,7 +186,12 @@ main(void) {
         //     continue;
         // }
 
+        /* Socket receive, message decode and the callbacks above all happen in
+         * here, but so does the wait of up to 1 s for the socket; the
+         * "callback" spans inside are the actual work */
+        UATRACE_BEGIN("run_iterate");
         UA_Client_run_iterate(client, 1000);
+        UATRACE_END("run_iterate");
     }
 
     /* Clean up - use disconnectAsync and process until fully disconnected */
@@ -200,5 +208,6 @@ main(void) {
     } while(sessionState != UA_SESSIONSTATE_CLOSED && channelState != UA_SECURECHANNELSTATE_CLOSED);
     
     UA_Client_delete(client);
+    UATRACE_DUMP();
     return EXIT_SUCCESS;
 }
@@ -5,6 +5,8 @@
 #include <QDebug>
 #include <QObject> // Needed for QObject::connect
 
+#include "uaclientpool.h"
+
 // Define the server endpoint URL
 const QString OpcUaEndpoint = "opc.tcp://m3:48400/UA/ComServerWrapper";
 
@@ -12,44 +14,41 @@ int main(int argc, char *argv[])
 {
     QCoreApplication a(argc, argv);
 
-    QOpcUaProvider provider;
-    if (provider.availableBackends().isEmpty())
+    UaClientPool pool;
+    if (!pool.isValid())
         return 1;
-    QOpcUaClient *client = provider.createClient(provider.availableBackends()[0]);
-    if (!client)
-        return 2;
-    // Connect to the stateChanged signal. Compatible slots of QObjects can be used instead of a lambda.
-    QObject::connect(client, &QOpcUaClient::stateChanged, [client](QOpcUaClient::ClientState state) {
-        qDebug() << "Client state changed:" << state;
-        if (state == QOpcUaClient::ClientState::Connected) {
-            QOpcUaNode *node = client->node("ns=2;s=0:TEST1/SGGN1/OUT.CV");
-            if (node) {
-                qDebug() << "A node object has been created";
-
-                QObject::connect(node, &QOpcUaNode::attributeRead,
-                                 [node, client](QOpcUa::NodeAttributes attr) {
-                                     if (attr == QOpcUa::NodeAttribute::Value) {
-                                         qDebug() << "Value: " << node->attribute(QOpcUa::NodeAttribute::Value);
-
-                                         client->deleteLater();
-                                         QCoreApplication::quit();
-                                     }
-                                 });
-
-                node->readValueAttribute();
-            }
 
+    // The pool hands out a connected client, picking the cheapest acceptable endpoint
+    QObject::connect(&pool, &UaClientPool::clientReady, [&pool](const QUrl &, QOpcUaClient *client) {
+        qDebug() << "Client connected";
+        QOpcUaNode *node = client->node("ns=2;s=0:TEST1/SGGN1/OUT.CV");
+        if (node) {
+            qDebug() << "A node object has been created";
+
+            QObject::connect(node, &QOpcUaNode::attributeRead,
+                             [node, client, &pool](QOpcUa::NodeAttributes attr) {
+                                 if (attr == QOpcUa::NodeAttribute::Value) {
+                                     qDebug() << "Value: " << node->attribute(QOpcUa::NodeAttribute::Value);
+
+                                     for (const QString &line : pool.statsSummary())
+                                         qDebug().noquote() << "Connect cost" << line;
+
+                                     node->deleteLater();
+                                     pool.release(client);
+                                     QCoreApplication::quit();
+                                 }
+                             });
+
+            node->readValueAttribute();
         }
     });
 
-    QObject::connect(client, &QOpcUaClient::endpointsRequestFinished,
-                     [client](QList<QOpcUaEndpointDescription> endpoints) {
-                         qDebug() << "Endpoints returned:" << endpoints.count();
-                         if (endpoints.size())
-                             client->connectToEndpoint(endpoints.first()); // Connect to the first endpoint in the list
-                     });
+    QObject::connect(&pool, &UaClientPool::acquireFailed, [](const QUrl &url, const QString &error) {
+        qDebug() << "Failed to connect to" << url.toString() << ":" << error;
+        QCoreApplication::exit(2);
+    });
 
-    client->requestEndpoints(QUrl("opc.tcp://m3:48400/UA/ComServerWrapper")); // Request a list of endpoints from the server
+    pool.acquire(QUrl(OpcUaEndpoint)); // Request endpoints and connect to the best ranked one
 
     return a.exec();
 }
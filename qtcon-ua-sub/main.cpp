@@ -8,6 +8,17 @@
 #include <QTextStream>
 #include <QSocketNotifier>
 #include <QThread>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QTemporaryFile>
+
+#include <functional>
+#include <memory>
+
+#include "uaclientpool.h"
+#include "uatrace_qt.h"
+#include "updatesink.h"
 
 #ifdef Q_OS_WIN
 #include <conio.h>
@@ -16,6 +27,7 @@
 #include <termios.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <time.h>
 #endif
 
 // Define the server endpoint URL
@@ -81,73 +93,168 @@ private:
 #endif
 };
 
+// CPU time used by the whole process so far. std::clock() would report wall
+// time on Windows.
+static double processCpuMs()
+{
+#ifdef Q_OS_WIN
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+        return 0;
+    auto ticks = [](const FILETIME &t) {
+        return (quint64(t.dwHighDateTime) << 32) | t.dwLowDateTime;
+    };
+    return (ticks(kernel) + ticks(user)) / 1e4; // 100 ns units
+#else
+    timespec ts;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0)
+        return 0;
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+#endif
+}
+
+// Feed the same synthetic updates through every sink and report process CPU
+// time, so the cost of the output path can be compared without a server.
+static void benchmarkSinks(int updates)
+{
+    QList<QVariant> values;
+    values.reserve(1000);
+    for (int i = 0; i < 1000; ++i)
+        values.append(QVariant(50.0 + 0.01 * i));
+
+    auto run = [&](const char *name, const std::function<void(qint64, const QVariant &)> &write,
+                   const std::function<void()> &finish) {
+        QElapsedTimer wall;
+        wall.start();
+        const double start = processCpuMs();
+        for (int i = 0; i < updates; ++i)
+            write(QDateTime::currentMSecsSinceEpoch(), values.at(i % values.size()));
+        finish();
+        const double cpuMs = processCpuMs() - start;
+        qDebug().noquote() << QString("%1 %2 ms CPU, %3 ms wall per %4 updates")
+                                  .arg(name, -10)
+                                  .arg(cpuMs, 8, 'f', 1)
+                                  .arg(wall.elapsed(), 6)
+                                  .arg(updates);
+    };
+
+    // The original per-update qDebug line, with output swallowed so only the
+    // formatting cost is measured
+    QtMessageHandler previous = qInstallMessageHandler([](QtMsgType, const QMessageLogContext &, const QString &) {});
+    run("legacy", [](qint64, const QVariant &value) {
+        qDebug() << qPrintable(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss.zzz AP") + " Subscription update - Value: " + value.toString());
+    }, []() {});
+    qInstallMessageHandler(previous);
+
+    FILE *textFile = std::tmpfile();
+    if (textFile) {
+        TextUpdateSink text(textFile);
+        const int tag = text.addTag("bench");
+        run("text", [&](qint64 timestamp, const QVariant &value) { text.write(tag, timestamp, value); },
+            [&]() { text.close(); });
+        std::fclose(textFile);
+    }
+
+    QTemporaryFile columnarFile;
+    if (columnarFile.open()) {
+        ColumnarUpdateSink columnar(columnarFile.fileName());
+        const int tag = columnar.addTag("bench");
+        run("columnar", [&](qint64 timestamp, const QVariant &value) { columnar.write(tag, timestamp, value); },
+            [&]() { columnar.close(); });
+    }
+}
+
 int main(int argc, char *argv[])
 {
-    QCoreApplication a(argc, argv);
+    UaTraceApplication<QCoreApplication> a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption sinkOption("sink", "Output sink for updates: text or columnar.", "sink", "text");
+    QCommandLineOption outputOption("output", "File written by the columnar sink.", "file", "qtcon-ua-sub.qcol");
+    QCommandLineOption benchOption("bench", "Benchmark every sink with 100000 synthetic updates and exit.");
+    parser.addOptions({ sinkOption, outputOption, benchOption });
+    parser.process(a);
 
-    QOpcUaProvider provider;
-    if (provider.availableBackends().isEmpty()) {
+    if (parser.isSet(benchOption)) {
+        benchmarkSinks(100000);
+        return 0;
+    }
+
+    std::unique_ptr<UpdateSink> sink;
+    if (parser.value(sinkOption) == "columnar") {
+        auto columnar = std::make_unique<ColumnarUpdateSink>(parser.value(outputOption));
+        if (!columnar->isOpen()) {
+            qDebug() << "Failed to open" << parser.value(outputOption) << columnar->errorString();
+            return 3;
+        }
+        sink = std::move(columnar);
+    } else {
+        sink = std::make_unique<TextUpdateSink>(stdout);
+    }
+    const int tag = sink->addTag("ns=2;s=0:TEST1/SGGN1/OUT.CV");
+
+    UaClientPool pool;
+    if (!pool.isValid()) {
         qDebug() << "No OPC UA backends available";
         return 1;
     }
-    
-    QOpcUaClient *client = provider.createClient(provider.availableBackends()[0]);
-    if (!client) {
-        qDebug() << "Failed to create OPC UA client";
-        return 2;
-    }
 
+    QOpcUaClient *client = nullptr;
     QOpcUaNode *node = nullptr;
 
-    // Connect to the stateChanged signal
-    QObject::connect(client, &QOpcUaClient::stateChanged, [client, &node, &a](QOpcUaClient::ClientState state) {
-        qDebug() << "Client state changed:" << state;
-        if (state == QOpcUaClient::ClientState::Connected) {
-            node = client->node("ns=2;s=0:TEST1/SGGN1/OUT.CV");
-            if (node) {
-                qDebug() << "Node object created, enabling monitoring";
-
-                // Connect to the attributeUpdated signal for subscription updates
-                QObject::connect(node, &QOpcUaNode::attributeUpdated,
-                                 [node](QOpcUa::NodeAttribute attr, QVariant value) {
-                                     if (attr == QOpcUa::NodeAttribute::Value) {
-                                        qDebug() << qPrintable(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss.zzz AP") + " Subscription update - Value: " + value.toString());
-                                     }
-                                 });
-
-                // Connect to enableMonitoringFinished to confirm subscription is active
-                QObject::connect(node, &QOpcUaNode::enableMonitoringFinished,
-                                 [](QOpcUa::NodeAttribute attr, QOpcUa::UaStatusCode status) {
-                                     qDebug() << "Monitoring enabled for attribute" << attr << "Status:" << status;
-                                 });
-
-                // Enable monitoring (subscription) for the Value attribute
-                QOpcUaMonitoringParameters parameters;
-                parameters.setSamplingInterval(1000); // 1 second sampling interval
-                node->enableMonitoring(QOpcUa::NodeAttribute::Value, parameters);
-            } else {
-                qDebug() << "Failed to create node object";
+    // The pool connects to the best ranked endpoint and hands the client over
+    QObject::connect(&pool, &UaClientPool::clientReady, [&client, &node, &a, &sink, tag](const QUrl &, QOpcUaClient *readyClient) {
+        client = readyClient;
+
+        // Connect to the stateChanged signal
+        QObject::connect(client, &QOpcUaClient::stateChanged, [&a, &client, &node](QOpcUaClient::ClientState state) {
+            qDebug() << "Client state changed:" << state;
+            if (state == QOpcUaClient::ClientState::Disconnected) {
+                qDebug() << "Disconnected state, ESC key or server exited";
+                // The pool drops disconnected clients
+                client = nullptr;
+                node = nullptr;
+                a.quit();
             }
-        } else if (state == QOpcUaClient::ClientState::Disconnected) {
-            qDebug() << "Disconnected state, ESC key or server exited";
-            a.quit();
+        });
+
+        node = client->node("ns=2;s=0:TEST1/SGGN1/OUT.CV");
+        if (node) {
+            qDebug() << "Node object created, enabling monitoring";
+
+            // Connect to the attributeUpdated signal for subscription updates
+            QObject::connect(node, &QOpcUaNode::attributeUpdated,
+                             [&sink, tag](QOpcUa::NodeAttribute attr, QVariant value) {
+                                 UATRACE_SCOPE("attributeUpdated");
+                                 if (attr == QOpcUa::NodeAttribute::Value) {
+                                     sink->write(tag, QDateTime::currentMSecsSinceEpoch(), value);
+                                 }
+                             });
+
+            // Connect to enableMonitoringFinished to confirm subscription is active
+            QObject::connect(node, &QOpcUaNode::enableMonitoringFinished,
+                             [](QOpcUa::NodeAttribute attr, QOpcUa::UaStatusCode status) {
+                                 qDebug() << "Monitoring enabled for attribute" << attr << "Status:" << status;
+                             });
+
+            // Enable monitoring (subscription) for the Value attribute
+            QOpcUaMonitoringParameters parameters;
+            parameters.setSamplingInterval(1000); // 1 second sampling interval
+            node->enableMonitoring(QOpcUa::NodeAttribute::Value, parameters);
+        } else {
+            qDebug() << "Failed to create node object";
         }
     });
 
-    // Handle endpoint request completion
-    QObject::connect(client, &QOpcUaClient::endpointsRequestFinished,
-                     [client, &node](QList<QOpcUaEndpointDescription> endpoints) {
-                         qDebug() << "Endpoints returned:" << endpoints.count();
-                         if (endpoints.size()) {
-                             client->connectToEndpoint(endpoints.first());
-                         } else {
-                             qDebug() << "No endpoints available";
-                         }
-                     });
+    QObject::connect(&pool, &UaClientPool::acquireFailed, [&a](const QUrl &url, const QString &error) {
+        qDebug() << "Failed to connect to" << url.toString() << ":" << error;
+        a.exit(2);
+    });
 
     // Set up keyboard handler for Escape key
     KeyboardHandler *keyHandler = new KeyboardHandler(&a);
-    QObject::connect(keyHandler, &KeyboardHandler::escapePressed, [&a, client, node]() {
+    QObject::connect(keyHandler, &KeyboardHandler::escapePressed, [&a, &client, &node]() {
         qDebug() << "Escape key pressed. Shutting down...";
 
         if (node) {
@@ -157,6 +264,8 @@ int main(int argc, char *argv[])
         if (client && client->state() == QOpcUaClient::ClientState::Connected) {
             qDebug() << "Disconnecting from endpoint...";
             client->disconnectFromEndpoint();
+        } else {
+            a.quit();
         }
     });
 
@@ -167,11 +276,24 @@ int main(int argc, char *argv[])
     });
     timer->start(10000); // Print status every 10 seconds
 
-    qDebug() << "Requesting endpoints from" << OpcUaEndpoint;
+    // Hand buffered text to the terminal a few times a second instead of per
+    // update; the columnar sink writes aged chunks and refreshes its footer
+    QTimer *flushTimer = new QTimer(&a);
+    QObject::connect(flushTimer, &QTimer::timeout, [&sink]() {
+        UATRACE_SCOPE("sink.flush");
+        sink->flush();
+    });
+    flushTimer->start(200);
+
     qDebug() << "Press Escape key to quit the application";
-    client->requestEndpoints(QUrl(OpcUaEndpoint));
+    pool.acquire(QUrl(OpcUaEndpoint));
 
-    return a.exec();
+    int result = a.exec();
+    sink->close();
+    UATRACE_DUMP();
+    for (const QString &line : pool.statsSummary())
+        qDebug().noquote() << "Connect cost" << line;
+    return result;
 }
 
 #include "main.moc"
@@ -0,0 +1,298 @@
+#include "updatesink.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QLocale>
+#include <QMetaType>
+
+#include <cstring>
+#include <utility>
+
+namespace {
+
+const char ColumnarMagic[8] = { 'Q', 'U', 'A', 'C', 'O', 'L', '1', '\0' };
+
+// Flush the text buffer once it grows past this many bytes
+const int TextBufferLimit = 64 * 1024;
+
+// Bool is kept apart so it still prints as true/false
+bool isIntegral(const QVariant &value)
+{
+    switch (value.typeId()) {
+    case QMetaType::Char:
+    case QMetaType::SChar:
+    case QMetaType::UChar:
+    case QMetaType::Short:
+    case QMetaType::UShort:
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::Long:
+    case QMetaType::ULong:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool isFloating(const QVariant &value)
+{
+    return value.typeId() == QMetaType::Double || value.typeId() == QMetaType::Float;
+}
+
+} // namespace
+
+int UpdateSink::addTag(const QString &name)
+{
+    m_tags.append(name);
+    return int(m_tags.size()) - 1;
+}
+
+TextUpdateSink::TextUpdateSink(FILE *stream)
+    : m_stream(stream)
+    , m_cachedSecond(-1)
+{
+    m_buffer.reserve(TextBufferLimit + 256);
+}
+
+TextUpdateSink::~TextUpdateSink()
+{
+    close();
+}
+
+int TextUpdateSink::addTag(const QString &name)
+{
+    m_tagLabels.append(" " + name.toUtf8() + ": ");
+    return UpdateSink::addTag(name);
+}
+
+void TextUpdateSink::write(int tag, qint64 timestampMs, const QVariant &value)
+{
+    // Only format the date when the second changes, the milliseconds are
+    // patched in by hand
+    const qint64 second = timestampMs / 1000;
+    if (second != m_cachedSecond) {
+        const QByteArray formatted = QDateTime::fromMSecsSinceEpoch(second * 1000)
+                                         .toString("yyyy-MM-dd hh:mm:ss.zzz AP")
+                                         .toLatin1();
+        m_prefix = formatted.left(20);
+        m_suffix = formatted.mid(23);
+        m_cachedSecond = second;
+    }
+
+    const int msec = int(timestampMs % 1000);
+    const char millis[3] = { char('0' + msec / 100), char('0' + msec / 10 % 10), char('0' + msec % 10) };
+
+    m_buffer.append(m_prefix);
+    m_buffer.append(millis, 3);
+    m_buffer.append(m_suffix);
+    m_buffer.append(m_tagLabels.value(tag, " ?: "));
+
+    if (isFloating(value))
+        m_buffer.append(QByteArray::number(value.toDouble(), 'g', QLocale::FloatingPointShortest));
+    else if (isIntegral(value))
+        m_buffer.append(QByteArray::number(value.toLongLong()));
+    else
+        m_buffer.append(value.toString().toUtf8());
+    m_buffer.append('\n');
+
+    if (m_buffer.size() > TextBufferLimit)
+        flush();
+}
+
+void TextUpdateSink::flush()
+{
+    if (m_buffer.isEmpty())
+        return;
+    fwrite(m_buffer.constData(), 1, size_t(m_buffer.size()), m_stream);
+    fflush(m_stream);
+    m_buffer.clear();
+}
+
+void TextUpdateSink::close()
+{
+    flush();
+}
+
+ColumnarUpdateSink::ColumnarUpdateSink(const QString &fileName, int blockRows, int maxChunkAgeMs)
+    : m_file(fileName)
+    , m_blockRows(qMax(1, blockRows))
+    , m_maxChunkAgeMs(maxChunkAgeMs)
+    , m_dataEnd(0)
+    , m_dropped(0)
+{
+    if (m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (m_file.write(ColumnarMagic, sizeof(ColumnarMagic)) != qint64(sizeof(ColumnarMagic))) {
+            qWarning() << "Columnar sink: cannot write" << fileName << m_file.errorString();
+            m_file.close();
+            return;
+        }
+        m_dataEnd = m_file.pos();
+        // An empty but complete file until the first chunk arrives
+        writeFooter();
+    }
+}
+
+ColumnarUpdateSink::~ColumnarUpdateSink()
+{
+    close();
+}
+
+int ColumnarUpdateSink::addTag(const QString &name)
+{
+    Column column;
+    column.timestamps.reserve(m_blockRows);
+    column.values.reserve(m_blockRows);
+    m_columns.append(column);
+    return UpdateSink::addTag(name);
+}
+
+void ColumnarUpdateSink::write(int tag, qint64 timestampMs, const QVariant &value)
+{
+    if (tag < 0 || tag >= m_columns.size() || !m_file.isOpen()) {
+        ++m_dropped;
+        return;
+    }
+
+    ValueType type;
+    qint64 bits;
+    if (isFloating(value)) {
+        const double d = value.toDouble();
+        std::memcpy(&bits, &d, sizeof(bits));
+        type = ValueType::Double;
+    } else if (isIntegral(value)) {
+        bits = value.toLongLong();
+        type = ValueType::Int64;
+    } else if (value.typeId() == QMetaType::Bool) {
+        bits = value.toBool() ? 1 : 0;
+        type = ValueType::Bool;
+    } else {
+        // Strings and structured values have no column representation
+        ++m_dropped;
+        return;
+    }
+
+    Column &column = m_columns[tag];
+    if (type != column.type) {
+        if (!column.timestamps.isEmpty()) {
+            writeChunk(tag);
+            writeFooter();
+        }
+        column.type = type;
+    }
+
+    column.timestamps.append(timestampMs);
+    column.values.append(bits);
+    if (column.timestamps.size() >= m_blockRows) {
+        writeChunk(tag);
+        writeFooter();
+    }
+}
+
+void ColumnarUpdateSink::flush()
+{
+    if (!m_file.isOpen())
+        return;
+
+    // Partial chunks are written once their oldest row reaches the maximum age
+    const qint64 cutoff = QDateTime::currentMSecsSinceEpoch() - m_maxChunkAgeMs;
+    bool written = false;
+    for (int tag = 0; tag < m_columns.size(); ++tag) {
+        const Column &column = m_columns.at(tag);
+        if (!column.timestamps.isEmpty() && column.timestamps.first() <= cutoff) {
+            writeChunk(tag);
+            written = true;
+        }
+    }
+
+    if (written) {
+        writeFooter();
+        m_file.flush();
+    }
+}
+
+void ColumnarUpdateSink::close()
+{
+    if (!m_file.isOpen())
+        return;
+
+    for (int tag = 0; tag < m_columns.size(); ++tag) {
+        if (!m_columns[tag].timestamps.isEmpty())
+            writeChunk(tag);
+    }
+    writeFooter();
+    m_file.close();
+}
+
+void ColumnarUpdateSink::writeChunk(int tag)
+{
+    Column &column = m_columns[tag];
+    const qsizetype rows = column.timestamps.size();
+    const qint64 bytes = rows * qint64(sizeof(qint64));
+
+    // New chunks overwrite the previous footer, callers write a new one right after
+    if (m_file.pos() != m_dataEnd)
+        m_file.seek(m_dataEnd);
+
+    if (m_file.write(reinterpret_cast<const char *>(column.timestamps.constData()), bytes) == bytes
+        && m_file.write(reinterpret_cast<const char *>(column.values.constData()), bytes) == bytes) {
+        ChunkIndex chunk;
+        chunk.tag = quint32(tag);
+        chunk.type = column.type;
+        chunk.rows = quint32(rows);
+        chunk.offset = quint64(m_dataEnd);
+        chunk.firstTimestamp = column.timestamps.first();
+        chunk.lastTimestamp = column.timestamps.last();
+        m_index.append(chunk);
+        m_dataEnd = m_file.pos();
+    } else {
+        // Anything partially written past m_dataEnd is overwritten next time
+        qWarning() << "Columnar sink: lost" << rows << "rows," << m_file.errorString();
+        m_dropped += rows;
+        m_file.seek(m_dataEnd);
+    }
+
+    // QList::clear() keeps the reserved capacity in Qt 6
+    column.timestamps.clear();
+    column.values.clear();
+}
+
+// Footer layout:
+//   quint32 tagCount, then per tag: quint16 nameLength, UTF-8 name
+//   quint32 chunkCount, then per chunk:
+//     quint32 tag, quint8 type, quint32 rows, quint64 offset,
+//     qint64 firstTimestamp, qint64 lastTimestamp
+void ColumnarUpdateSink::writeFooter()
+{
+    if (m_file.pos() != m_dataEnd)
+        m_file.seek(m_dataEnd);
+    const quint64 footerOffset = quint64(m_dataEnd);
+
+    QDataStream out(&m_file);
+    out.setByteOrder(QDataStream::LittleEndian);
+
+    out << quint32(m_tags.size());
+    for (const QString &name : std::as_const(m_tags)) {
+        const QByteArray utf8 = name.toUtf8();
+        out << quint16(utf8.size());
+        out.writeRawData(utf8.constData(), int(utf8.size()));
+    }
+
+    out << quint32(m_index.size());
+    for (const ChunkIndex &chunk : std::as_const(m_index)) {
+        out << chunk.tag << quint8(chunk.type) << chunk.rows << chunk.offset
+            << chunk.firstTimestamp << chunk.lastTimestamp;
+    }
+
+    out << footerOffset;
+    out.writeRawData(ColumnarMagic, sizeof(ColumnarMagic));
+
+    if (out.status() != QDataStream::Ok) {
+        qWarning() << "Columnar sink: cannot write footer," << m_file.errorString();
+        return;
+    }
+    // Drop the tail of an older, longer footer
+    m_file.resize(m_file.pos());
+}
@@ -0,0 +1,127 @@
+#ifndef UPDATESINK_H
+#define UPDATESINK_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QtGlobal>
+
+#include <cstdio>
+
+// Destination for subscription updates. Timestamps are milliseconds since the
+// epoch so the hot path never has to format a QDateTime.
+class UpdateSink
+{
+public:
+    virtual ~UpdateSink() = default;
+
+    // Register a tag and get the index to pass to write().
+    virtual int addTag(const QString &name);
+
+    virtual void write(int tag, qint64 timestampMs, const QVariant &value) = 0;
+
+    // Push buffered output to the device. Called periodically from the event loop.
+    virtual void flush() {}
+
+    // Write everything that is still buffered and finish the output.
+    virtual void close() {}
+
+protected:
+    QStringList m_tags;
+};
+
+// Human readable lines: "yyyy-MM-dd hh:mm:ss.zzz AP <tag> <value>".
+// The date/time prefix is rebuilt only when the second changes.
+class TextUpdateSink : public UpdateSink
+{
+public:
+    explicit TextUpdateSink(FILE *stream);
+    ~TextUpdateSink() override;
+
+    int addTag(const QString &name) override;
+    void write(int tag, qint64 timestampMs, const QVariant &value) override;
+    void flush() override;
+    void close() override;
+
+private:
+    FILE *m_stream;
+    QByteArray m_buffer;
+    QList<QByteArray> m_tagLabels;
+    qint64 m_cachedSecond;
+    QByteArray m_prefix; // "yyyy-MM-dd hh:mm:ss."
+    QByteArray m_suffix; // " AM" / " PM"
+};
+
+// Column oriented binary file. Each tag buffers timestamps (int64) and values
+// (double, int64 or bool) and writes them out as one chunk per tag once the
+// block is full or the oldest buffered row is older than the maximum chunk
+// age. A footer indexes every chunk so a reader can seek to a single tag.
+// New chunks overwrite the old footer and a new footer follows them in the
+// same call, so a killed process leaves a readable file unless it dies inside
+// that write. Every rewrite copies the whole footer, the chunk age trades
+// flush latency against that cost.
+//
+// Layout (host byte order, little endian on every supported target):
+//   "QUACOL1\0"
+//   chunk*            qint64 timestamps[rows], then 8 byte values[rows]
+//   footer            see writeFooter()
+//   quint64 footerOffset
+//   "QUACOL1\0"
+class ColumnarUpdateSink : public UpdateSink
+{
+public:
+    enum class ValueType : quint8 {
+        Double = 0,
+        Int64 = 1,
+        Bool = 2 // stored as int64 0 / 1
+    };
+
+    explicit ColumnarUpdateSink(const QString &fileName, int blockRows = 65536,
+                                int maxChunkAgeMs = 60000);
+    ~ColumnarUpdateSink() override;
+
+    bool isOpen() const { return m_file.isOpen(); }
+    QString errorString() const { return m_file.errorString(); }
+    qint64 droppedValues() const { return m_dropped; }
+
+    int addTag(const QString &name) override;
+    void write(int tag, qint64 timestampMs, const QVariant &value) override;
+    void flush() override;
+    void close() override;
+
+private:
+    // The value type is fixed per chunk; a column switches type only at a
+    // chunk boundary.
+    struct Column
+    {
+        ValueType type = ValueType::Double;
+        QList<qint64> timestamps;
+        QList<qint64> values; // doubles are stored bit-for-bit
+    };
+
+    struct ChunkIndex
+    {
+        quint32 tag;
+        ValueType type;
+        quint32 rows;
+        quint64 offset;
+        qint64 firstTimestamp;
+        qint64 lastTimestamp;
+    };
+
+    void writeChunk(int tag);
+    void writeFooter();
+
+    QFile m_file;
+    int m_blockRows;
+    int m_maxChunkAgeMs;
+    QList<Column> m_columns;
+    QList<ChunkIndex> m_index;
+    qint64 m_dataEnd; // chunks end here, the footer follows
+    qint64 m_dropped;
+};
+
+#endif // UPDATESINK_H
@@ -1,11 +1,14 @@
 #include "mainwindow.h"
+#include "uatrace_qt.h"
 
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
-    QApplication a(argc, argv);
+    UaTraceApplication<QApplication> a(argc, argv);
     MainWindow w;
     w.show();
-    return a.exec();
+    int result = a.exec();
+    UATRACE_DUMP();
+    return result;
 }
@@ -7,14 +7,35 @@
 #include <QtCharts/QChartView>
 #include <QtCharts/QLineSeries>
 #include <QtCharts/QValueAxis>
+#include <QtCharts/QLegendMarker>
+#include <QElapsedTimer>
+
+#include "uatrace.h"
+
+// Chart refresh period, all notifications in between are drawn together
+static const int FrameIntervalMs = 33;
+// Seconds of history shown on the shared time axis
+static const double TimeWindowSeconds = 60.0;
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
-    , m_provider(nullptr)
+    , m_pool(nullptr)
     , m_client(nullptr)
-    , m_node(nullptr)
     , m_connected(false)
+    , m_store(TimeWindowSeconds)
+    , m_frameTimer(nullptr)
+    , m_statsLabel(nullptr)
+    , m_refreshPending(false)
+    , m_lastFrom(0)
+    , m_updateMs(0)
+    , m_paintMs(0)
+    , m_frameUpdates(0)
+    , m_peakFrameMs(0)
+    , m_peakThisSecond(0)
+    , m_lastTag(-1)
+    , m_updatesThisSecond(0)
+    , m_updateRate(0)
 {
     ui->setupUi(this);
     
@@ -24,25 +45,38 @@ MainWindow::MainWindow(QWidget *parent)
     // Connect the Connect/Disconnect button
     connect(ui->pushButtonConnectDisconned, &QPushButton::clicked, this, &MainWindow::connectDisconnect);
     
-    // Initialize OPC UA provider
-    m_provider = new QOpcUaProvider(this);
-    if (m_provider->availableBackends().isEmpty()) {
+    // Initialize OPC UA client pool, it keeps sessions warm between connects
+    m_pool = new UaClientPool(this);
+    if (!m_pool->isValid()) {
         QMessageBox::critical(this, "Error", "No OPC UA backends available");
         return;
     }
+    connect(m_pool, &UaClientPool::clientReady, this, &MainWindow::onClientReady);
+    connect(m_pool, &UaClientPool::acquireFailed, this, [this](const QUrl &, const QString &error) {
+        QMessageBox::critical(this, "Error", error);
+        onClientStateChanged(QOpcUaClient::ClientState::Disconnected);
+    });
     
     // Set initial UI state
     ui->lineEditValue->setReadOnly(true);
     
     // Setup chart
     setupChart();
+
+    // Frame time and updates per frame in the status bar
+    m_statsLabel = new QLabel(this);
+    ui->statusbar->addPermanentWidget(m_statsLabel);
+
+    m_frameTimer = new QTimer(this);
+    connect(m_frameTimer, &QTimer::timeout, this, &MainWindow::refreshChart);
+    connect(ui->chartView, &TimedChartView::painted, this, &MainWindow::onChartPainted);
+    m_frameTimer->start(FrameIntervalMs);
+    m_rateClock.start();
 }
 
 MainWindow::~MainWindow()
 {
-    if (m_client && m_connected) {
-        m_client->disconnectFromEndpoint();
-    }
+    // The pool disconnects its clients when it is destroyed
     delete ui;
 }
 
@@ -61,41 +95,37 @@ void MainWindow::connectDisconnect()
             return;
         }
         
-        if (m_client) {
-            m_client->deleteLater();
-        }
-        
-        m_client = m_provider->createClient(m_provider->availableBackends()[0]);
-        if (!m_client) {
-            QMessageBox::critical(this, "Error", "Failed to create OPC UA client");
-            return;
-        }
-        
-        connect(m_client, &QOpcUaClient::stateChanged, this, &MainWindow::onClientStateChanged);
-        connect(m_client, &QOpcUaClient::endpointsRequestFinished,
-                [this](QList<QOpcUaEndpointDescription> endpoints) {
-                    if (endpoints.isEmpty()) {
-                        QMessageBox::critical(this, "Error", "No endpoints available");
-                        return;
-                    }
-                    m_client->connectToEndpoint(endpoints.first());
-                });
-        
         ui->pushButtonConnectDisconned->setText("Connecting...");
         ui->pushButtonConnectDisconned->setEnabled(false);
         
-        m_client->requestEndpoints(QUrl(url));
+        // Reuses a warm session for this URL if the pool still has one
+        m_pool->acquire(QUrl(url));
     } else {
         // Disconnect
-        if (m_node) {
-            m_node->disableMonitoring(QOpcUa::NodeAttribute::Value);
+        for (const Trend &trend : std::as_const(m_trends)) {
+            if (trend.node)
+                trend.node->disableMonitoring(QOpcUa::NodeAttribute::Value);
         }
         if (m_client) {
-            m_client->disconnectFromEndpoint();
+            // Hand the session back instead of closing it, so the next
+            // connect skips the handshake
+            disconnect(m_client, nullptr, this, nullptr);
+            m_pool->release(m_client);
+            m_client = nullptr;
         }
+        onClientStateChanged(QOpcUaClient::ClientState::Disconnected);
     }
 }
 
+void MainWindow::onClientReady(const QUrl &url, QOpcUaClient *client)
+{
+    Q_UNUSED(url);
+
+    m_client = client;
+    connect(m_client, &QOpcUaClient::stateChanged, this, &MainWindow::onClientStateChanged);
+    onClientStateChanged(QOpcUaClient::ClientState::Connected);
+}
+
 void MainWindow::onClientStateChanged(QOpcUaClient::ClientState state)
 {
     qDebug() << "Client state changed:" << state;
@@ -107,28 +137,25 @@ void MainWindow::onClientStateChanged(QOpcUaClient::ClientState state)
             ui->pushButtonConnectDisconned->setText("Disconnect");
             ui->pushButtonConnectDisconned->setEnabled(true);
             
-            QString nodeId = ui->lineEditNodeId->text().trimmed();
-            if (!nodeId.isEmpty()) {
-                m_node = m_client->node(nodeId);
-                if (m_node) {
-                    connect(m_node, &QOpcUaNode::attributeUpdated, this, &MainWindow::onValueUpdated);
-                    
-                    QOpcUaMonitoringParameters parameters;
-                    parameters.setSamplingInterval(1000); // 1 second
-                    m_node->enableMonitoring(QOpcUa::NodeAttribute::Value, parameters);
-                }
+            QStringList nodeIds;
+            const QStringList lines = ui->plainTextEditNodeIds->toPlainText().split('\n');
+            for (const QString &line : lines) {
+                if (!line.trimmed().isEmpty())
+                    nodeIds.append(line.trimmed());
             }
+            createTrends(nodeIds);
         }
         break;
         
     case QOpcUaClient::ClientState::Disconnected:
+        // The pool deletes clients whose session dropped
+        m_client = nullptr;
         m_connected = false;
         ui->pushButtonConnectDisconned->setText("Connect");
         ui->pushButtonConnectDisconned->setEnabled(true);
         ui->lineEditValue->clear();
         // Clear chart data
-        m_series->clear();
-        m_startTime = QDateTime::currentDateTime();
+        removeTrends();
         break;
         
     case QOpcUaClient::ClientState::Connecting:
@@ -141,17 +168,97 @@ void MainWindow::onClientStateChanged(QOpcUaClient::ClientState state)
     }
 }
 
-void MainWindow::onValueUpdated(QOpcUa::NodeAttribute attr, QVariant value)
+void MainWindow::createTrends(const QStringList &nodeIds)
+{
+    removeTrends();
+    m_store.reset(int(nodeIds.size()));
+
+    // Identical shared parameters put every monitored item into the same
+    // subscription
+    QOpcUaMonitoringParameters parameters;
+    parameters.setSamplingInterval(1000); // 1 second
+    parameters.setSubscriptionType(QOpcUaMonitoringParameters::SubscriptionType::Shared);
+
+    for (int tag = 0; tag < nodeIds.size(); ++tag) {
+        Trend trend;
+        trend.nodeId = nodeIds.at(tag);
+
+        trend.series = new QLineSeries();
+        trend.series->setName(trend.nodeId);
+        // Markers only pay off while a single trend is shown
+        trend.series->setPointsVisible(nodeIds.size() == 1);
+        trend.series->setMarkerSize(4.0); // Size of the markers (50% smaller)
+        m_chart->addSeries(trend.series);
+        trend.series->attachAxis(m_axisX);
+        trend.series->attachAxis(m_axisY);
+
+        // Clicking a legend entry hides the trend; hidden trends are skipped
+        // by refreshChart()
+        const QList<QLegendMarker *> markers = m_chart->legend()->markers(trend.series);
+        for (QLegendMarker *marker : markers) {
+            connect(marker, &QLegendMarker::clicked, this, [this, tag, marker]() {
+                QLineSeries *series = m_trends.at(tag).series;
+                series->setVisible(!series->isVisible());
+                marker->setVisible(true);
+                QColor color = marker->labelBrush().color();
+                color.setAlphaF(series->isVisible() ? 1.0 : 0.4);
+                marker->setLabelBrush(color);
+                m_store.markDirty(tag);
+                m_refreshPending = true;
+            });
+        }
+
+        trend.node = m_client->node(trend.nodeId);
+        if (trend.node) {
+            QOpcUaNode *node = trend.node;
+            connect(trend.node, &QOpcUaNode::attributeUpdated, this,
+                    [this, tag, node](QOpcUa::NodeAttribute attr, QVariant value) {
+                        // Ignore updates still queued for a node from an earlier connect
+                        if (tag < m_trends.size() && m_trends.at(tag).node == node)
+                            onValueUpdated(tag, attr, value);
+                    });
+            trend.node->enableMonitoring(QOpcUa::NodeAttribute::Value, parameters);
+        } else {
+            qDebug() << "Failed to create node object for" << trend.nodeId;
+        }
+
+        m_trends.append(trend);
+    }
+
+    m_axisX->setRange(0, TimeWindowSeconds);
+}
+
+void MainWindow::removeTrends()
 {
+    for (const Trend &trend : std::as_const(m_trends)) {
+        if (trend.node) {
+            // Stop updates for the old tag indices before the next trends reuse them
+            disconnect(trend.node, nullptr, this, nullptr);
+            trend.node->deleteLater();
+        }
+    }
+    m_trends.clear();
+    m_chart->removeAllSeries();
+    m_store.reset(0);
+    m_lastTag = -1;
+    m_lastValue.clear();
+    m_refreshPending = true;
+}
+
+void MainWindow::onValueUpdated(int tag, QOpcUa::NodeAttribute attr, const QVariant &value)
+{
+    UATRACE_SCOPE("onValueUpdated");
     if (attr == QOpcUa::NodeAttribute::Value) {
-        ui->lineEditValue->setText(value.toString());
-        qDebug() << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss.zzz AP") << "Value updated:" << value;
+        // The value field is refreshed with the chart, once per frame
+        m_lastTag = tag;
+        m_lastValue = value;
+        ++m_updatesThisSecond;
         
         // Add data point to chart
         bool ok;
         double numericValue = value.toDouble(&ok);
         if (ok) {
-            addDataPoint(numericValue);
+            addDataPoint(tag, numericValue);
         }
     }
 }
@@ -163,20 +270,10 @@ void MainWindow::setupChart()
     m_chart->setTitle("OPC UA Data");
     m_chart->setAnimationOptions(QChart::NoAnimation);
     
-    // Create line series
-    m_series = new QLineSeries();
-    m_series->setName("Value");
-    
-    // Enable markers on data points
-    m_series->setPointsVisible(true);
-    m_series->setMarkerSize(4.0); // Size of the markers (50% smaller)
-    
-    m_chart->addSeries(m_series);
-    
     // Create axes
     m_axisX = new QValueAxis();
     m_axisX->setTitleText("Time (seconds)");
-    m_axisX->setRange(0, 60); // Show last 60 seconds
+    m_axisX->setRange(0, TimeWindowSeconds); // Show last 60 seconds
     m_axisX->setTickCount(7); // Show 7 tick marks
     
     m_axisY = new QValueAxis();
@@ -185,52 +282,119 @@ void MainWindow::setupChart()
     
     m_chart->addAxis(m_axisX, Qt::AlignBottom);
     m_chart->addAxis(m_axisY, Qt::AlignLeft);
-    m_series->attachAxis(m_axisX);
-    m_series->attachAxis(m_axisY);
     
     // Set chart to chart view
     ui->chartView->setChart(m_chart);
     ui->chartView->setRenderHint(QPainter::Antialiasing);
-    
-    // Initialize start time
-    m_startTime = QDateTime::currentDateTime();
 }
 
-void MainWindow::addDataPoint(double value)
+void MainWindow::addDataPoint(int tag, double value)
 {
-    // Calculate time elapsed since start in seconds
-    qint64 elapsed = m_startTime.msecsTo(QDateTime::currentDateTime()) / 1000.0;
-    
-    // Add point to series
-    m_series->append(elapsed, value);
-    
-    // Keep only last 100 points for performance
-    if (m_series->count() > 100) {
-        m_series->removePoints(0, m_series->count() - 100);
+    UATRACE_SCOPE("addDataPoint");
+    // Only record the sample, the series are rebuilt in refreshChart()
+    m_store.append(tag, value);
+}
+
+void MainWindow::refreshChart()
+{
+    QElapsedTimer frame;
+    frame.start();
+
+    UATRACE_SCOPE("refreshChart");
+    const int updates = m_store.takePendingUpdates();
+    UATRACE_COUNTER("updates_per_frame", updates);
+
+    if (m_rateClock.elapsed() >= 1000) {
+        m_updateRate = int(m_updatesThisSecond * 1000 / m_rateClock.restart());
+        m_updatesThisSecond = 0;
+        m_peakFrameMs = m_peakThisSecond;
+        m_peakThisSecond = 0;
     }
-    
-    // Auto-adjust Y axis range
-    if (!m_series->points().isEmpty()) {
-        QList<QPointF> points = m_series->points();
-        double minY = points.first().y();
-        double maxY = points.first().y();
-        
-        for (const QPointF &point : points) {
-            minY = qMin(minY, point.y());
-            maxY = qMax(maxY, point.y());
+
+    // Nothing new to draw, or nobody can see it. The status bar keeps the
+    // numbers of the last drawn frame.
+    if (updates == 0 && !m_refreshPending) {
+        showFrameStats();
+        return;
+    }
+    if (isMinimized() || !isVisible()) {
+        m_refreshPending = true;
+        return;
+    }
+    m_refreshPending = false;
+
+    if (m_lastTag >= 0 && m_lastTag < m_trends.size())
+        ui->lineEditValue->setText(m_trends.at(m_lastTag).nodeId + ": " + m_lastValue.toString());
+
+    // Shared time axis showing the last 60 seconds
+    const double latest = m_store.latestTime();
+    const double from = latest > TimeWindowSeconds ? latest - TimeWindowSeconds : 0;
+    const double to = latest > TimeWindowSeconds ? latest : TimeWindowSeconds;
+    m_axisX->setRange(from, to);
+
+    // Samples scrolled out of every series, so cached Y extents are stale
+    if (from != m_lastFrom) {
+        for (int tag = 0; tag < m_trends.size(); ++tag)
+            m_store.markDirty(tag);
+        m_lastFrom = from;
+    }
+
+    // One min/max pair per horizontal pixel is all the chart can show
+    const int buckets = qMax(1, int(m_chart->plotArea().width()));
+
+    double minY = 0;
+    double maxY = 0;
+    bool hasRange = false;
+    for (int tag = 0; tag < m_trends.size(); ++tag) {
+        Trend &trend = m_trends[tag];
+        if (!trend.series->isVisible())
+            continue;
+
+        if (m_store.isDirty(tag)) {
+            const QList<QPointF> points = m_store.decimate(tag, from, to, buckets, &trend.minY, &trend.maxY);
+            trend.hasRange = !points.isEmpty();
+            UATRACE_SCOPE("chart.replace");
+            trend.series->replace(points);
         }
-        
+
+        if (trend.hasRange) {
+            minY = hasRange ? qMin(minY, trend.minY) : trend.minY;
+            maxY = hasRange ? qMax(maxY, trend.maxY) : trend.maxY;
+            hasRange = true;
+        }
+    }
+
+    // Auto-adjust Y axis range
+    if (hasRange) {
         // Add some padding
         double padding = (maxY - minY) * 0.1;
         if (padding == 0) padding = 1; // Minimum padding
         
         m_axisY->setRange(minY - padding, maxY + padding);
     }
-    
-    // Auto-adjust X axis to show last 60 seconds
-    if (elapsed > 60) {
-        m_axisX->setRange(elapsed - 60, elapsed);
-    } else {
-        m_axisX->setRange(0, 60);
-    }
+
+    // The chart repaints afterwards, onChartPainted() completes the frame
+    m_updateMs = frame.nsecsElapsed() / 1e6;
+    m_paintMs = 0;
+    m_frameUpdates = updates;
+    showFrameStats();
+}
+
+void MainWindow::onChartPainted(double msecs)
+{
+    m_paintMs = msecs;
+    m_peakThisSecond = qMax(m_peakThisSecond, m_updateMs + m_paintMs);
+    showFrameStats();
+}
+
+void MainWindow::showFrameStats()
+{
+    m_statsLabel->setText(QString("Frame %1 ms (update %2 + paint %3), peak %4 ms | Updates/frame %5 | %6 upd/s | %7 tags")
+                              .arg(m_updateMs + m_paintMs, 0, 'f', 2)
+                              .arg(m_updateMs, 0, 'f', 2)
+                              .arg(m_paintMs, 0, 'f', 2)
+                              .arg(m_peakFrameMs, 0, 'f', 2)
+                              .arg(m_frameUpdates)
+                              .arg(m_updateRate)
+                              .arg(m_trends.size()));
 }
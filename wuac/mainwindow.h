@@ -3,13 +3,18 @@
 
 #include <QMainWindow>
 #include <QOpcUaClient>
-#include <QOpcUaProvider>
 #include <QOpcUaNode>
-#include <QDateTime>
+#include <QElapsedTimer>
+#include <QLabel>
+#include <QList>
+#include <QTimer>
 #include <QtCharts/QChart>
 #include <QtCharts/QLineSeries>
 #include <QtCharts/QValueAxis>
 
+#include "trendstore.h"
+#include "uaclientpool.h"
+
 QT_BEGIN_NAMESPACE
 namespace Ui {
 class MainWindow;
@@ -27,24 +32,56 @@ public:
 private slots:
     void exitApplication();
     void connectDisconnect();
+    void onClientReady(const QUrl &url, QOpcUaClient *client);
     void onClientStateChanged(QOpcUaClient::ClientState state);
-    void onValueUpdated(QOpcUa::NodeAttribute attr, QVariant value);
+    void refreshChart();
+    void onChartPainted(double msecs);
 
 private:
+    // One monitored tag and the series that draws it
+    struct Trend
+    {
+        QString nodeId;
+        QOpcUaNode *node = nullptr;
+        QLineSeries *series = nullptr;
+        double minY = 0;
+        double maxY = 0;
+        bool hasRange = false;
+    };
+
     Ui::MainWindow *ui;
-    QOpcUaProvider *m_provider;
+    UaClientPool *m_pool;
     QOpcUaClient *m_client;
-    QOpcUaNode *m_node;
+    QList<Trend> m_trends;
     bool m_connected;
     
     // Chart components
     QChart *m_chart;
-    QLineSeries *m_series;
     QValueAxis *m_axisX;
     QValueAxis *m_axisY;
-    QDateTime m_startTime;
+    TrendStore m_store;
+
+    // Frame pacing and load statistics
+    QTimer *m_frameTimer;
+    QLabel *m_statsLabel;
+    bool m_refreshPending;
+    double m_lastFrom;
+    double m_updateMs;       // decimation and replace() of the last drawn frame
+    double m_paintMs;        // chart repaint that followed it
+    int m_frameUpdates;      // samples that arrived for the last drawn frame
+    double m_peakFrameMs;    // worst frame of the previous second
+    double m_peakThisSecond;
+    int m_lastTag;
+    QVariant m_lastValue;
+    int m_updatesThisSecond;
+    int m_updateRate;
+    QElapsedTimer m_rateClock;
     
     void setupChart();
-    void addDataPoint(double value);
+    void createTrends(const QStringList &nodeIds);
+    void removeTrends();
+    void onValueUpdated(int tag, QOpcUa::NodeAttribute attr, const QVariant &value);
+    void addDataPoint(int tag, double value);
+    void showFrameStats();
 };
 #endif // MAINWINDOW_H
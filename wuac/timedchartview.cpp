@@ -0,0 +1,17 @@
+#include "timedchartview.h"
+
+#include <QElapsedTimer>
+
+TimedChartView::TimedChartView(QWidget *parent)
+    : QChartView(parent)
+{
+}
+
+void TimedChartView::paintEvent(QPaintEvent *event)
+{
+    // Viewport paints arrive here through QAbstractScrollArea::viewportEvent
+    QElapsedTimer timer;
+    timer.start();
+    QChartView::paintEvent(event);
+    emit painted(timer.nsecsElapsed() / 1e6);
+}
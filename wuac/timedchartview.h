@@ -0,0 +1,21 @@
+#ifndef TIMEDCHARTVIEW_H
+#define TIMEDCHARTVIEW_H
+
+#include <QtCharts/QChartView>
+
+// Chart view that reports how long each repaint of the chart took
+class TimedChartView : public QChartView
+{
+    Q_OBJECT
+
+public:
+    explicit TimedChartView(QWidget *parent = nullptr);
+
+signals:
+    void painted(double msecs);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+};
+
+#endif // TIMEDCHARTVIEW_H
@@ -0,0 +1,114 @@
+#include "trendstore.h"
+
+#include <algorithm>
+#include <limits>
+
+TrendStore::TrendStore(double historySeconds)
+    : m_historySeconds(historySeconds)
+    , m_latestTime(0)
+    , m_pending(0)
+{
+    m_clock.start();
+}
+
+void TrendStore::reset(int tagCount)
+{
+    m_tags.clear();
+    m_tags.resize(tagCount);
+    m_clock.restart();
+    m_latestTime = 0;
+    m_pending = 0;
+}
+
+double TrendStore::now() const
+{
+    return m_clock.nsecsElapsed() / 1e9;
+}
+
+void TrendStore::append(int tag, double value)
+{
+    if (tag < 0 || tag >= m_tags.size())
+        return;
+
+    const double t = now();
+    Tag &entry = m_tags[tag];
+    entry.points.append(QPointF(t, value));
+    entry.dirty = true;
+    m_latestTime = t;
+    ++m_pending;
+
+    // Skip samples that have scrolled out of the history window, and only
+    // move the rest down once the expired ones make up half the list
+    const double cutoff = t - m_historySeconds;
+    while (entry.start < entry.points.size() && entry.points.at(entry.start).x() < cutoff)
+        ++entry.start;
+    if (entry.start > entry.points.size() / 2) {
+        entry.points.remove(0, entry.start);
+        entry.start = 0;
+    }
+}
+
+int TrendStore::takePendingUpdates()
+{
+    const int pending = m_pending;
+    m_pending = 0;
+    return pending;
+}
+
+QList<QPointF> TrendStore::decimate(int tag, double from, double to, int buckets,
+                                    double *minY, double *maxY)
+{
+    Tag &entry = m_tags[tag];
+    entry.dirty = false;
+
+    const QList<QPointF> &points = entry.points;
+    auto first = std::lower_bound(points.cbegin() + entry.start, points.cend(), from,
+                                  [](const QPointF &p, double x) { return p.x() < x; });
+    auto last = std::upper_bound(first, points.cend(), to,
+                                 [](double x, const QPointF &p) { return x < p.x(); });
+
+    QList<QPointF> result;
+    *minY = std::numeric_limits<double>::max();
+    *maxY = std::numeric_limits<double>::lowest();
+    if (first == last)
+        return result;
+
+    buckets = std::max(buckets, 1);
+    if (last - first <= 2 * buckets) {
+        result.reserve(last - first);
+        for (auto it = first; it != last; ++it) {
+            result.append(*it);
+            *minY = std::min(*minY, it->y());
+            *maxY = std::max(*maxY, it->y());
+        }
+        return result;
+    }
+
+    // Keep the lowest and highest sample of every bucket, in time order, so
+    // spikes survive the reduction
+    result.reserve(2 * buckets);
+    const double scale = buckets / std::max(to - from, 1e-9);
+    auto it = first;
+    while (it != last) {
+        const int bucket = int((it->x() - from) * scale);
+        QPointF low = *it;
+        QPointF high = *it;
+        for (++it; it != last && int((it->x() - from) * scale) == bucket; ++it) {
+            if (it->y() < low.y())
+                low = *it;
+            if (it->y() > high.y())
+                high = *it;
+        }
+        if (low.x() <= high.x()) {
+            result.append(low);
+            if (high != low)
+                result.append(high);
+        } else {
+            result.append(high);
+            result.append(low);
+        }
+        *minY = std::min(*minY, low.y());
+        *maxY = std::max(*maxY, high.y());
+    }
+    return result;
+}
@@ -0,0 +1,51 @@
+#ifndef TRENDSTORE_H
+#define TRENDSTORE_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QPointF>
+
+// Samples for every monitored tag on one shared time base (seconds since
+// reset()). Notifications only append here; the chart pulls decimated copies
+// once per frame.
+class TrendStore
+{
+public:
+    explicit TrendStore(double historySeconds = 60.0);
+
+    void reset(int tagCount);
+    int tagCount() const { return int(m_tags.size()); }
+
+    // Seconds since reset() on the shared time axis
+    double now() const;
+    double latestTime() const { return m_latestTime; }
+
+    void append(int tag, double value);
+
+    bool isDirty(int tag) const { return m_tags.at(tag).dirty; }
+    void markDirty(int tag) { m_tags[tag].dirty = true; }
+
+    // Updates appended since the last call
+    int takePendingUpdates();
+
+    // Min/max per bucket over [from, to], at most 2 * buckets points.
+    // Clears the dirty flag and reports the Y extent of the returned points.
+    QList<QPointF> decimate(int tag, double from, double to, int buckets,
+                            double *minY, double *maxY);
+
+private:
+    struct Tag
+    {
+        QList<QPointF> points;
+        qsizetype start = 0; // points before this have left the history window
+        bool dirty = false;
+    };
+
+    QList<Tag> m_tags;
+    QElapsedTimer m_clock;
+    double m_historySeconds;
+    double m_latestTime;
+    int m_pending;
+};
+
+#endif // TRENDSTORE_H